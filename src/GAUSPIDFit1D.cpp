@@ -3,6 +3,7 @@
 #include <string>
 
 #include "name_helpers.hpp"
+#include "slice_helpers.hpp"
 
 namespace GAUSPID
 {
@@ -33,8 +34,12 @@ namespace GAUSPID
 
     void Fit1D::WriteHist()
     {
-        _fit->SetNpx(1000);
-        _hist->Write();
+        slice_helpers::write_hist(_hist, _fit);
+    }
+
+    bool Fit1D::MergeHist(TFile* file)
+    {
+        return slice_helpers::merge_hist(_hist, file);
     }
 
 }
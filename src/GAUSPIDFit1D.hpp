@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <TF1.h>
+#include <TFile.h>
 #include <TH1F.h>
 
 namespace GAUSPID
@@ -19,6 +20,7 @@ namespace GAUSPID
         void FillHist(const float p, const float mass2);
         TF1* Fit();
         void WriteHist();
+        bool MergeHist(TFile* file);
 
         const float GetPMin() const
         {
@@ -9,8 +9,6 @@
 #include <TH1F.h>
 #include <TH2D.h>
 #include <TThread.h>
-#include "AnalysisTree/Chain.hpp"
-#include "AnalysisTree/Matching.hpp"
 #include "GAUSPIDFit1D.hpp"
 
 namespace GAUSPID
@@ -22,14 +20,20 @@ namespace GAUSPID
             const std::vector<int> pdg,
             const float p_min,
             const float p_max,
-            const unsigned int n_bins,
-            const std::string filename);
+            const unsigned int n_bins);
 
-        void FillHists();
+        void Fill(const float p, const float mass2, const int mc_pdg);
         void FitHists();
         void WriteHists();
+        void WritePartialHists();
+        bool MergeHists(TFile* file);
         TF2* ConcatenateFits();
 
+        const std::vector<Fit1D>& GetFits() const
+        {
+            return _fits;
+        }
+
     private:
         std::vector<Fit1D> _fits;
         TF2* _fit2d;
@@ -37,6 +41,5 @@ namespace GAUSPID
         const float _p_max;
         const std::vector<int> _pdg;
         const unsigned int _n_bins;
-        const std::string _filename;
     };
 } // namespace GAUSPID
@@ -0,0 +1,258 @@
+#include "GAUSPIDFitJoint1D.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <Math/Factory.h>
+#include <Math/IFunction.h>
+#include <Math/Minimizer.h>
+
+#include "name_helpers.hpp"
+#include "slice_helpers.hpp"
+
+namespace GAUSPID
+{
+    namespace
+    {
+        constexpr unsigned int kGausPars = 3;
+        constexpr unsigned int kBgPars = 3;
+
+        // Baker-Cousins binned Poisson likelihood of
+        //   mu(x) = sum_k A_k exp(-(x - m_k)^2 / 2 s_k^2) + exp(c_0 + c_1 x + c_2 x^2)
+        // evaluated at the bin centres. Parameters are laid out as
+        // (A_0, m_0, s_0, ..., A_n, m_n, s_n, c_0, c_1, c_2).
+        class BinnedLikelihood : public ROOT::Math::IMultiGradFunction
+        {
+        public:
+            BinnedLikelihood(const TH1F* hist, const unsigned int n_species) :
+                _n_species{n_species}
+            {
+                for(int i = 1; i <= hist->GetNbinsX(); ++i)
+                {
+                    _x.push_back(hist->GetBinCenter(i));
+                    _n.push_back(hist->GetBinContent(i));
+                }
+            }
+
+            ROOT::Math::IMultiGenFunction* Clone() const override
+            {
+                return new BinnedLikelihood(*this);
+            }
+
+            unsigned int NDim() const override
+            {
+                return _n_species * kGausPars + kBgPars;
+            }
+
+            void Gradient(const double* p, double* grad) const override
+            {
+                double f;
+                FdF(p, f, grad);
+            }
+
+            void FdF(const double* p, double& f, double* grad) const override
+            {
+                const unsigned int n_dim = NDim();
+                std::fill(grad, grad + n_dim, 0.);
+                std::vector<double> dmu(n_dim);
+                f = 0;
+                for(size_t i = 0; i < _x.size(); ++i)
+                {
+                    const double mu = Mu(p, _x[i], dmu.data());
+                    const double n = _n[i];
+                    f += Term(mu, n);
+                    const double w = 1. - n / mu;
+                    for(unsigned int j = 0; j < n_dim; ++j)
+                    {
+                        grad[j] += w * dmu[j];
+                    }
+                }
+                _cached_p.assign(p, p + n_dim);
+                _cached_grad.assign(grad, grad + n_dim);
+            }
+
+        private:
+            // expected counts at x; the derivatives are only filled if dmu is given
+            double Mu(const double* p, const double x, double* dmu) const
+            {
+                const unsigned int i_bg = _n_species * kGausPars;
+                double mu = 0;
+                for(unsigned int k = 0; k < _n_species; ++k)
+                {
+                    const double* g = p + k * kGausPars;
+                    const double dx = x - g[1];
+                    const double inv_s2 = 1. / (g[2] * g[2]);
+                    const double e = std::exp(-0.5 * dx * dx * inv_s2);
+                    const double gaus = g[0] * e;
+                    mu += gaus;
+                    if(dmu)
+                    {
+                        dmu[k * kGausPars] = e;
+                        dmu[k * kGausPars + 1] = gaus * dx * inv_s2;
+                        dmu[k * kGausPars + 2] = gaus * dx * dx * inv_s2 / g[2];
+                    }
+                }
+                const double bg = std::exp(p[i_bg] + p[i_bg + 1] * x + p[i_bg + 2] * x * x);
+                mu += bg;
+                if(dmu)
+                {
+                    dmu[i_bg] = bg;
+                    dmu[i_bg + 1] = bg * x;
+                    dmu[i_bg + 2] = bg * x * x;
+                }
+                return mu;
+            }
+
+            static double Term(const double mu, const double n)
+            {
+                return n > 0 ? mu - n + n * std::log(n / mu) : mu;
+            }
+
+            double DoEval(const double* p) const override
+            {
+                double f = 0;
+                for(size_t i = 0; i < _x.size(); ++i)
+                {
+                    f += Term(Mu(p, _x[i], nullptr), _n[i]);
+                }
+                return f;
+            }
+
+            // Minuit asks for the whole gradient, but single components are
+            // served from the last full evaluation when the point is unchanged
+            double DoDerivative(const double* p, unsigned int icoord) const override
+            {
+                if(_cached_p.empty() || !std::equal(_cached_p.begin(), _cached_p.end(), p))
+                {
+                    std::vector<double> grad(NDim());
+                    Gradient(p, grad.data());
+                }
+                return _cached_grad[icoord];
+            }
+
+            std::vector<double> _x;
+            std::vector<double> _n;
+            const unsigned int _n_species;
+            mutable std::vector<double> _cached_p;
+            mutable std::vector<double> _cached_grad;
+        };
+    }
+
+    FitJoint1D::FitJoint1D(const std::vector<std::vector<int>> pdgs, const float p_min, const float p_max, const float m2_min, const float m2_max) :
+        _p_min{p_min}, _p_max{p_max}
+    {
+        auto hist_name = name_helpers::create_1d_joint_hist_name(p_min, p_max);
+        auto hist_title = name_helpers::create_1d_joint_fit_title(p_min, p_max);
+        _hist = new TH1F(hist_name.c_str(), hist_title.c_str(), 400, m2_min, m2_max);
+
+        std::string formula = "";
+        for(size_t k = 0; k < pdgs.size(); ++k)
+        {
+            auto fit_name = name_helpers::create_1d_joint_fit_name(pdgs[k], p_min, p_max);
+            _species_fits.push_back(new TF1(fit_name.c_str(), "gaus", m2_min, m2_max));
+            formula += "gaus(" + std::to_string(k * kGausPars) + ")+";
+        }
+        const auto i_bg = pdgs.size() * kGausPars;
+        const std::string bg_formula = "exp([0]+[1]*x+[2]*x*x)";
+        auto bg_name = name_helpers::create_1d_joint_fit_name("background", p_min, p_max);
+        _bg_fit = new TF1(bg_name.c_str(), bg_formula.c_str(), m2_min, m2_max);
+        formula += "exp([" + std::to_string(i_bg) + "]+[" + std::to_string(i_bg + 1) +
+            "]*x+[" + std::to_string(i_bg + 2) + "]*x*x)";
+
+        auto fit_name = name_helpers::create_1d_joint_fit_name("total", p_min, p_max);
+        _fit = new TF1(fit_name.c_str(), formula.c_str(), m2_min, m2_max);
+        _hist->GetListOfFunctions()->Add(_fit);
+    }
+
+    void FitJoint1D::FillHist(const float p, const float mass2)
+    {
+        if(p > _p_min && p <= _p_max)
+        {
+            _hist->Fill(mass2);
+        }
+    }
+
+    bool FitJoint1D::Fit(const std::vector<const TF1*>& seeds)
+    {
+        const unsigned int n_species = _species_fits.size();
+        const unsigned int i_bg = n_species * kGausPars;
+        const double m2_min = _hist->GetXaxis()->GetXmin();
+        const double m2_max = _hist->GetXaxis()->GetXmax();
+        const double bin_width = _hist->GetBinWidth(1);
+
+        std::vector<double> params(i_bg + kBgPars, 0.);
+        if(!HasEntries())
+        {
+            // nothing to fit, keep the components at zero but well defined
+            for(unsigned int k = 0; k < n_species; ++k)
+            {
+                params[k * kGausPars + 1] = std::clamp(seeds[k]->GetParameter(1), m2_min, m2_max);
+                params[k * kGausPars + 2] = 0.05;
+            }
+            params[i_bg] = -10;
+            SetParameters(params);
+            return false;
+        }
+
+        std::unique_ptr<ROOT::Math::Minimizer> minimizer(
+            ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad"));
+        if(!minimizer)
+        {
+            std::cerr << "Minuit2 minimizer is not available" << std::endl;
+            return false;
+        }
+        BinnedLikelihood likelihood(_hist, n_species);
+        minimizer->SetFunction(likelihood);
+        // the likelihood is -ln L up to a constant, one sigma is at +0.5
+        minimizer->SetErrorDef(0.5);
+        minimizer->SetPrintLevel(0);
+
+        for(unsigned int k = 0; k < n_species; ++k)
+        {
+            const TF1* seed = seeds[k];
+            const double mean = std::clamp(seed->GetParameter(1), m2_min, m2_max);
+            const double sigma = seed->GetParameter(2) > bin_width ? seed->GetParameter(2) : 0.05;
+            const double amplitude = std::max(seed->GetParameter(0), 1.);
+            const auto name = std::to_string(k);
+            minimizer->SetLowerLimitedVariable(
+                k * kGausPars, "A_" + name, amplitude, 0.1 * amplitude, 0.);
+            minimizer->SetLimitedVariable(
+                k * kGausPars + 1, "m_" + name, mean, 0.1 * sigma, m2_min, m2_max);
+            minimizer->SetLimitedVariable(
+                k * kGausPars + 2, "s_" + name, sigma, 0.1 * sigma, 0.5 * bin_width, m2_max - m2_min);
+        }
+        const double mean_content = _hist->GetEntries() / _hist->GetNbinsX();
+        minimizer->SetVariable(i_bg, "c_0", std::log(std::max(0.1 * mean_content, 1e-3)), 0.1);
+        minimizer->SetLimitedVariable(i_bg + 1, "c_1", 0., 0.1, -20., 20.);
+        minimizer->SetLimitedVariable(i_bg + 2, "c_2", 0., 0.1, -20., 20.);
+
+        const bool converged = minimizer->Minimize();
+        const double* x = minimizer->X();
+        std::copy(x, x + params.size(), params.begin());
+        SetParameters(params);
+        return converged;
+    }
+
+    void FitJoint1D::SetParameters(const std::vector<double>& params)
+    {
+        for(size_t k = 0; k < _species_fits.size(); ++k)
+        {
+            _species_fits[k]->SetParameters(params.data() + k * kGausPars);
+        }
+        _bg_fit->SetParameters(params.data() + _species_fits.size() * kGausPars);
+        _fit->SetParameters(params.data());
+    }
+
+    void FitJoint1D::WriteHist()
+    {
+        slice_helpers::write_hist(_hist, _fit);
+    }
+
+    bool FitJoint1D::MergeHist(TFile* file)
+    {
+        return slice_helpers::merge_hist(_hist, file);
+    }
+
+}
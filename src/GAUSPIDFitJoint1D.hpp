@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <TF1.h>
+#include <TFile.h>
+#include <TH1F.h>
+
+namespace GAUSPID
+{
+    // Joint fit of all species gaussians plus an exp(pol2) background to the
+    // inclusive m^2 spectrum of one momentum slice. The fit minimises the
+    // binned Poisson likelihood with analytic gradients.
+    class FitJoint1D
+    {
+    public:
+        FitJoint1D(
+            const std::vector<std::vector<int>> pdgs,
+            const float p_min,
+            const float p_max,
+            const float m2_min = -1,
+            const float m2_max = 2);
+
+        void FillHist(const float p, const float mass2);
+        // seeds are the truth-matched single gaussian fits, one per species
+        bool Fit(const std::vector<const TF1*>& seeds);
+        void WriteHist();
+        bool MergeHist(TFile* file);
+
+        bool HasEntries() const
+        {
+            return _hist->GetEntries() > 0;
+        }
+
+        const float GetPMin() const
+        {
+            return _p_min;
+        }
+
+        const float GetPMax() const
+        {
+            return _p_max;
+        }
+
+        const TF1* GetSpeciesFunc(const size_t i_species) const
+        {
+            return _species_fits[i_species];
+        }
+
+        const TF1* GetBackgroundFunc() const
+        {
+            return _bg_fit;
+        }
+
+    private:
+        void SetParameters(const std::vector<double>& params);
+
+        TH1F* _hist;
+        TF1* _fit;
+        std::vector<TF1*> _species_fits;
+        TF1* _bg_fit;
+
+        const float _p_min;
+        const float _p_max;
+    };
+
+}
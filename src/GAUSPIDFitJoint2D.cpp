@@ -0,0 +1,103 @@
+#include "GAUSPIDFitJoint2D.hpp"
+
+#include <iostream>
+
+#include "name_helpers.hpp"
+#include "slice_helpers.hpp"
+
+namespace GAUSPID
+{
+    FitJoint2D::FitJoint2D(
+        const std::vector<std::vector<int>> pdgs,
+        const float p_min,
+        const float p_max,
+        const unsigned int n_bins) :
+        _p_min{p_min}, _p_max{p_max}, _pdgs{pdgs}
+    {
+        // same slicing as Fit2D, so the truth-matched seeds line up by index
+        float delta = (p_max - p_min) / n_bins;
+        for(float min = 0; min < _p_max; min += delta)
+        {
+            _fits.push_back(FitJoint1D(_pdgs, min, min + delta));
+        }
+    }
+
+    void FitJoint2D::Fill(const float p, const float mass2)
+    {
+        for(auto& fit: _fits)
+        {
+            fit.FillHist(p, mass2);
+        }
+    }
+
+    void FitJoint2D::FitHists(const std::vector<Fit2D>& seeds)
+    {
+        for(size_t i = 0; i < _fits.size(); ++i)
+        {
+            std::vector<const TF1*> slice_seeds;
+            for(auto& seed: seeds)
+            {
+                slice_seeds.push_back(seed.GetFits()[i].GetFitFunc());
+            }
+            if(!_fits[i].Fit(slice_seeds) && _fits[i].HasEntries())
+            {
+                std::cerr << "Joint fit did not converge for p in (" << _fits[i].GetPMin()
+                          << ", " << _fits[i].GetPMax() << ")" << std::endl;
+            }
+        }
+    }
+
+    void FitJoint2D::WriteHists()
+    {
+        slice_helpers::write_hists(_fits);
+        for(auto fit2d: _fits2d)
+        {
+            slice_helpers::write_fit2d(fit2d);
+        }
+    }
+
+    void FitJoint2D::WritePartialHists()
+    {
+        slice_helpers::write_hists(_fits);
+    }
+
+    bool FitJoint2D::MergeHists(TFile* file)
+    {
+        return slice_helpers::merge_hists(_fits, file);
+    }
+
+    std::vector<TF2*> FitJoint2D::ConcatenateFits()
+    {
+        _fits2d.clear();
+        for(size_t k = 0; k < _pdgs.size(); ++k)
+        {
+            auto name = name_helpers::create_2d_joint_fit_name(_pdgs[k]);
+            auto title = name_helpers::create_2d_joint_fit_title(name_helpers::pdgs_to_string(_pdgs[k]));
+            _fits2d.push_back(ConcatenateFit(name, title, k));
+        }
+        auto bg_name = name_helpers::create_2d_joint_fit_name("background");
+        auto bg_title = name_helpers::create_2d_joint_fit_title("background");
+        _fits2d.push_back(ConcatenateFit(bg_name, bg_title, -1));
+        return _fits2d;
+    }
+
+    // i_species < 0 selects the background component
+    TF2* FitJoint2D::ConcatenateFit(const std::string& name, const std::string& title, const int i_species)
+    {
+        auto fit_lambda = [this, i_species](Double_t* x, Double_t* p)
+        {
+            auto fit = slice_helpers::find_slice(this->_fits, x[0]);
+            // a slice without training data must not claim any tracks
+            if(!fit || !fit->HasEntries())
+            {
+                return 0.;
+            }
+            auto func = i_species < 0 ? fit->GetBackgroundFunc() : fit->GetSpeciesFunc(i_species);
+            return func->Eval(x[1]);
+        };
+
+        auto fit2d = new TF2(name.c_str(), fit_lambda, this->_p_min, this->_p_max, -1., 2., 0);
+        fit2d->SetTitle(title.c_str());
+        return fit2d;
+    }
+}
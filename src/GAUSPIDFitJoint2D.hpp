@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <TF1.h>
+#include <TF2.h>
+#include <TFile.h>
+#include <TH1F.h>
+#include "GAUSPIDFit2D.hpp"
+#include "GAUSPIDFitJoint1D.hpp"
+
+namespace GAUSPID
+{
+    class FitJoint2D
+    {
+    public:
+        FitJoint2D(
+            const std::vector<std::vector<int>> pdgs,
+            const float p_min,
+            const float p_max,
+            const unsigned int n_bins);
+
+        void Fill(const float p, const float mass2);
+        // seeds are the truth-matched fits of each species in pdgs order,
+        // built with the same momentum binning
+        void FitHists(const std::vector<Fit2D>& seeds);
+        void WriteHists();
+        void WritePartialHists();
+        bool MergeHists(TFile* file);
+        std::vector<TF2*> ConcatenateFits();
+
+    private:
+        TF2* ConcatenateFit(const std::string& name, const std::string& title, const int i_species);
+
+        std::vector<FitJoint1D> _fits;
+        std::vector<TF2*> _fits2d;
+        const float _p_min;
+        const float _p_max;
+        const std::vector<std::vector<int>> _pdgs;
+    };
+} // namespace GAUSPID
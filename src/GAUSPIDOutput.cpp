@@ -0,0 +1,119 @@
+#include "GAUSPIDOutput.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <THnSparse.h>
+
+namespace GAUSPID
+{
+    bool ParseCompressionAlgorithm(const std::string& name, OutputConfig& config)
+    {
+        using Algorithm = ROOT::RCompressionSetting::EAlgorithm;
+        if(name == "zlib")
+        {
+            config.algorithm = Algorithm::kZLIB;
+        }
+        else if(name == "lzma")
+        {
+            config.algorithm = Algorithm::kLZMA;
+        }
+        else if(name == "lz4")
+        {
+            config.algorithm = Algorithm::kLZ4;
+        }
+        else if(name == "zstd")
+        {
+            config.algorithm = Algorithm::kZSTD;
+        }
+        else if(name == "default")
+        {
+            config.algorithm = Algorithm::kUseGlobal;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    bool ParseCompressionLevel(const std::string& level, OutputConfig& config)
+    {
+        if(level.size() != 1 || level[0] < '0' || level[0] > '9')
+        {
+            return false;
+        }
+        config.level = level[0] - '0';
+        return true;
+    }
+
+    TFile* OpenOutputFile(const std::string& path, const OutputConfig& config)
+    {
+        TFile* file = nullptr;
+        if(config.algorithm == ROOT::RCompressionSetting::EAlgorithm::kUseGlobal && config.level < 0)
+        {
+            file = TFile::Open(path.c_str(), "recreate");
+        }
+        else
+        {
+            file = TFile::Open(path.c_str(), "recreate", "", CompressionSettings(config));
+        }
+        if(!file || file->IsZombie())
+        {
+            std::cerr << "Could not create output file " << path << std::endl;
+            delete file;
+            return nullptr;
+        }
+        return file;
+    }
+
+    int CompressionSettings(const OutputConfig& config)
+    {
+        auto level = config.level;
+        if(level < 0)
+        {
+            using Algorithm = ROOT::RCompressionSetting::EAlgorithm;
+            using Level = ROOT::RCompressionSetting::ELevel;
+            switch(config.algorithm)
+            {
+            case Algorithm::kLZ4:
+                level = Level::kDefaultLZ4;
+                break;
+            case Algorithm::kZSTD:
+                level = Level::kDefaultZSTD;
+                break;
+            case Algorithm::kLZMA:
+                level = Level::kDefaultLZMA;
+                break;
+            default:
+                level = Level::kDefaultZLIB;
+                break;
+            }
+        }
+        return ROOT::CompressionSettings(config.algorithm, level);
+    }
+
+    void WriteHist(TFile* file, TH1* hist, const OutputConfig& config)
+    {
+        if(config.sparse && hist->GetDimension() == 2)
+        {
+            auto sparse = THnSparse::CreateSparse(hist->GetName(), hist->GetTitle(), hist);
+            file->WriteTObject(sparse);
+            delete sparse;
+            return;
+        }
+        file->WriteTObject(hist);
+    }
+
+    void PrintOutputReport(const std::string& path, const double write_seconds)
+    {
+        std::error_code error;
+        auto size = std::filesystem::file_size(path, error);
+        if(error)
+        {
+            std::cerr << "Could not stat output file " << path << std::endl;
+            return;
+        }
+        std::cout << "Output: " << path << ", " << size / 1024. / 1024. << " MB written in "
+                  << write_seconds << " s" << std::endl;
+    }
+}
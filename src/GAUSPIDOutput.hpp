@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <Compression.h>
+#include <TFile.h>
+#include <TH1.h>
+
+namespace GAUSPID
+{
+    struct OutputConfig
+    {
+        ROOT::RCompressionSetting::EAlgorithm::EValues algorithm =
+            ROOT::RCompressionSetting::EAlgorithm::kUseGlobal;
+        // negative picks the recommended level of the chosen algorithm
+        int level = -1;
+        // store two dimensional histograms as THnSparse, which only keeps
+        // filled bins and pays off for mostly empty phase space
+        bool sparse = false;
+    };
+
+    // Accepts zlib, lzma, lz4, zstd and default; returns false for anything else.
+    bool ParseCompressionAlgorithm(const std::string& name, OutputConfig& config);
+
+    // Accepts a single digit 0-9; returns false for anything else.
+    bool ParseCompressionLevel(const std::string& level, OutputConfig& config);
+
+    // Returns nullptr, after printing the reason, if the file cannot be created.
+    TFile* OpenOutputFile(const std::string& path, const OutputConfig& config);
+
+    // ROOT's algorithm * 100 + level encoding, with the recommended level of
+    // the algorithm filled in when none was given.
+    int CompressionSettings(const OutputConfig& config);
+
+    // Writes explicitly into file rather than gDirectory, so it is safe to
+    // call from a thread other than the one that opened the file.
+    void WriteHist(TFile* file, TH1* hist, const OutputConfig& config);
+
+    void PrintOutputReport(const std::string& path, const double write_seconds);
+}
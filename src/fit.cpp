@@ -1,4 +1,14 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <TClass.h>
+#include <TKey.h>
+#include "AnalysisTree/Chain.hpp"
+#include "AnalysisTree/Matching.hpp"
 #include "GAUSPIDFit2D.hpp"
+#include "GAUSPIDFitJoint2D.hpp"
+#include "GAUSPIDOutput.hpp"
 
 static inline bool check_argparse(const char* arg, const std::string long_form, const std::string short_form)
 {
@@ -7,11 +17,194 @@ static inline bool check_argparse(const char* arg, const std::string long_form,
     return (res1 == 0) || (res2 == 0);
 }
 
+// Writes every njobs-th line of the filelist, starting at line job, to out_path.
+// Round-robin keeps the jobs balanced when file sizes drift along the list.
+// Returns the number of files in the job's share, or -1 on I/O errors.
+static int split_filelist(const std::string& filelist_path, int job, int njobs, const std::string& out_path)
+{
+    std::ifstream in(filelist_path);
+    if(!in)
+    {
+        return -1;
+    }
+    std::ofstream out(out_path);
+    if(!out)
+    {
+        return -1;
+    }
+    std::string line;
+    int i_line = 0;
+    int n_files = 0;
+    while(std::getline(in, line))
+    {
+        if(line.empty())
+        {
+            continue;
+        }
+        if(i_line++ % njobs == job)
+        {
+            out << line << std::endl;
+            ++n_files;
+        }
+    }
+    return n_files;
+}
+
+// Fills the truth-matched histograms of every species and, if given, the
+// inclusive histograms of the joint fit in a single pass over the chain.
+static void fill_hists(const std::string& filelist_path, std::vector<GAUSPID::Fit2D>& fits, GAUSPID::FitJoint2D* joint_fit)
+{
+    namespace at = AnalysisTree;
+    auto chain = new at::Chain(
+        std::vector<std::string>({filelist_path}), std::vector<std::string>({"rTree"}));
+    chain->InitPointersToBranches({"VtxTracks", "TofHits"});
+
+    auto* config = chain->GetConfiguration();
+    auto* data_header = chain->GetDataHeader();
+
+    data_header->Print();
+    config->Print();
+
+    auto vtx_tracks = chain->GetBranchObject("VtxTracks");
+    auto tof_hits = chain->GetBranchObject("TofHits");
+    auto vtx2tof_match = chain->GetMatching("VtxTracks", "TofHits");
+
+    auto mc_pdg_vtx = vtx_tracks.GetField("mc_pdg");
+    auto qp_tof = tof_hits.GetField("qp_tof");
+    auto mass2_tof = tof_hits.GetField("mass2");
+
+    for(long i_event = 0; i_event < chain->GetEntries(); ++i_event)
+    {
+        chain->GetEntry(i_event);
+        for(size_t i = 0; i < vtx_tracks.size(); ++i)
+        {
+            auto mc_pdg = vtx_tracks[i][mc_pdg_vtx];
+            const auto matched_track_tof_id = vtx2tof_match->GetMatch(i);
+            if(matched_track_tof_id > 0)
+            {
+                auto qp = tof_hits[matched_track_tof_id][qp_tof];
+                auto mass2 = tof_hits[matched_track_tof_id][mass2_tof];
+                for(auto& fit: fits)
+                {
+                    fit.Fill(qp, mass2, mc_pdg);
+                }
+                if(joint_fit)
+                {
+                    joint_fit->Fill(qp, mass2);
+                }
+            }
+        }
+    }
+}
+
+static bool same_value(const double a, const double b)
+{
+    return std::abs(a - b) <= 1e-6 * std::max({1., std::abs(a), std::abs(b)});
+}
+
+// Compares every histogram of two gauss_fit output files bin by bin, together
+// with the parameters of the fits attached to them. Used to check that a
+// map/reduce run reproduces the single process model.
+static bool compare_models(const std::string& path_a, const std::string& path_b)
+{
+    TFile* file_a = TFile::Open(path_a.c_str(), "read");
+    TFile* file_b = TFile::Open(path_b.c_str(), "read");
+    if(!file_a || file_a->IsZombie() || !file_b || file_b->IsZombie())
+    {
+        std::cerr << "Could not open " << path_a << " or " << path_b << std::endl;
+        return false;
+    }
+
+    auto is_hist = [](TKey* key)
+    { return TClass::GetClass(key->GetClassName())->InheritsFrom(TH1::Class()); };
+
+    int n_hists = 0;
+    int n_fits = 0;
+    int n_differences = 0;
+    TIter next_key(file_a->GetListOfKeys());
+    while(auto key = static_cast<TKey*>(next_key()))
+    {
+        if(!is_hist(key))
+        {
+            continue;
+        }
+        TH1* hist_a;
+        TH1* hist_b;
+        file_a->GetObject(key->GetName(), hist_a);
+        file_b->GetObject(key->GetName(), hist_b);
+        ++n_hists;
+        if(!hist_b)
+        {
+            std::cerr << key->GetName() << " is missing in " << path_b << std::endl;
+            ++n_differences;
+            continue;
+        }
+        bool same_hist = hist_a->GetNcells() == hist_b->GetNcells() &&
+            hist_a->GetEntries() == hist_b->GetEntries();
+        for(int i = 0; same_hist && i < hist_a->GetNcells(); ++i)
+        {
+            same_hist = hist_a->GetBinContent(i) == hist_b->GetBinContent(i);
+        }
+        if(!same_hist)
+        {
+            std::cerr << key->GetName() << " differs" << std::endl;
+            ++n_differences;
+        }
+
+        TIter next_func(hist_a->GetListOfFunctions());
+        while(auto obj = next_func())
+        {
+            auto func_a = dynamic_cast<TF1*>(obj);
+            if(!func_a)
+            {
+                continue;
+            }
+            ++n_fits;
+            auto func_b = dynamic_cast<TF1*>(hist_b->GetListOfFunctions()->FindObject(func_a->GetName()));
+            bool same_fit = func_b && func_a->GetNpar() == func_b->GetNpar();
+            for(int i = 0; same_fit && i < func_a->GetNpar(); ++i)
+            {
+                same_fit = same_value(func_a->GetParameter(i), func_b->GetParameter(i));
+            }
+            if(!same_fit)
+            {
+                std::cerr << func_a->GetName() << " parameters differ" << std::endl;
+                ++n_differences;
+            }
+        }
+        delete hist_a;
+        delete hist_b;
+    }
+    int n_hists_b = 0;
+    TIter next_key_b(file_b->GetListOfKeys());
+    while(auto key = static_cast<TKey*>(next_key_b()))
+    {
+        n_hists_b += is_hist(key);
+    }
+    if(n_hists != n_hists_b)
+    {
+        std::cerr << path_a << " and " << path_b << " do not hold the same objects" << std::endl;
+        ++n_differences;
+    }
+    file_a->Close();
+    file_b->Close();
+
+    std::cout << "Compared " << n_hists << " histograms and " << n_fits << " fits, "
+              << n_differences << " differences" << std::endl;
+    return n_differences == 0;
+}
+
 int main(int argc, char** argv)
 {
     std::string filelist_path = "filelist_train.txt";
     std::string out_path = "gauss_out.root";
+    std::string mode = "full";
+    std::vector<std::string> partial_paths;
     int nbins = 50;
+    int job = 0;
+    int njobs = 1;
+    bool joint = false;
+    GAUSPID::OutputConfig output_config;
 
     using namespace std;
     for(int i = 1; i < argc; ++i)
@@ -31,6 +224,107 @@ int main(int argc, char** argv)
             nbins = atoi(argv[++i]);
             cout << "Number of bins: " << nbins << endl;
         }
+        if(check_argparse(argv[i], "--mode", "-m"))
+        {
+            mode = std::string(argv[++i]);
+            cout << "Mode: " << mode << endl;
+        }
+        if(check_argparse(argv[i], "--input", "-i"))
+        {
+            partial_paths.push_back(std::string(argv[++i]));
+            cout << "Partial input path: " << partial_paths.back() << endl;
+        }
+        if(check_argparse(argv[i], "--job", "-j"))
+        {
+            job = atoi(argv[++i]);
+            cout << "Job index: " << job << endl;
+        }
+        if(check_argparse(argv[i], "--njobs", "-nj"))
+        {
+            njobs = atoi(argv[++i]);
+            cout << "Number of jobs: " << njobs << endl;
+        }
+        if(check_argparse(argv[i], "--joint", "-jf"))
+        {
+            joint = true;
+            cout << "Joint species + background fit enabled" << endl;
+        }
+        if(check_argparse(argv[i], "--compression", "-c"))
+        {
+            if(!GAUSPID::ParseCompressionAlgorithm(argv[++i], output_config))
+            {
+                cerr << "Unknown compression algorithm: " << argv[i] << endl;
+                return 1;
+            }
+            cout << "Compression algorithm: " << argv[i] << endl;
+        }
+        if(check_argparse(argv[i], "--compression-level", "-cl"))
+        {
+            if(!GAUSPID::ParseCompressionLevel(argv[++i], output_config))
+            {
+                cerr << "Invalid compression level: " << argv[i] << " (expected 0-9)" << endl;
+                return 1;
+            }
+            cout << "Compression level: " << output_config.level << endl;
+        }
+    }
+
+    // full:   fill, fit and write the model in one process
+    // map:    fill from (a job's share of) the filelist, write histograms only
+    // merge:  sum partial files into a new partial file
+    // reduce: sum partial files, fit and write the model
+    // compare: check that two model or partial files hold the same histograms and fits
+    if(mode == "compare")
+    {
+        if(partial_paths.size() != 2)
+        {
+            cerr << "Mode compare requires exactly two --input files" << endl;
+            return 1;
+        }
+        return compare_models(partial_paths[0], partial_paths[1]) ? 0 : 1;
+    }
+    const bool fill = mode == "full" || mode == "map";
+    const bool fit_hists = mode == "full" || mode == "reduce";
+    if(!fill && !fit_hists && mode != "merge")
+    {
+        cerr << "Unknown mode: " << mode << " (expected full, map, merge, reduce or compare)" << endl;
+        return 1;
+    }
+    if(!fill && partial_paths.empty())
+    {
+        cerr << "Mode " << mode << " requires at least one --input partial file" << endl;
+        return 1;
+    }
+    if(njobs < 1 || job < 0 || job >= njobs)
+    {
+        cerr << "Invalid job index " << job << " for " << njobs << " jobs" << endl;
+        return 1;
+    }
+    if(njobs > 1 && mode != "map")
+    {
+        cerr << "--job/--njobs split the filelist and are only valid in map mode" << endl;
+        return 1;
+    }
+
+    std::string job_filelist_path = "";
+    if(fill && njobs > 1)
+    {
+        job_filelist_path = out_path + ".filelist.txt";
+        const int n_files = split_filelist(filelist_path, job, njobs, job_filelist_path);
+        if(n_files < 0)
+        {
+            cerr << "Could not split filelist " << filelist_path << endl;
+            return 1;
+        }
+        if(n_files == 0)
+        {
+            std::remove(job_filelist_path.c_str());
+            cerr << "Job " << job << " of " << njobs << " has no files: " << filelist_path
+                 << " lists fewer files than there are jobs" << endl;
+            return 1;
+        }
+        filelist_path = job_filelist_path;
+        cout << "Job filelist path: " << filelist_path << " (" << n_files << " files)" << endl;
     }
 
     const float p_min = 0;
@@ -44,31 +338,104 @@ int main(int argc, char** argv)
     std::vector<GAUSPID::Fit2D> fits;
     for(auto& pdg: pdgs)
     {
-        fits.push_back(GAUSPID::Fit2D(pdg, p_min, p_max, nbins, filelist_path));
+        fits.push_back(GAUSPID::Fit2D(pdg, p_min, p_max, nbins));
+    }
+    GAUSPID::FitJoint2D* joint_fit = nullptr;
+    if(joint)
+    {
+        joint_fit = new GAUSPID::FitJoint2D(
+            std::vector<std::vector<int>>(pdgs.begin(), pdgs.end()), p_min, p_max, nbins);
     }
 
-    std::cout << "Filling histograms..." << std::endl;
-    for(auto& fit: fits)
+    if(fill)
+    {
+        std::cout << "Filling histograms..." << std::endl;
+        fill_hists(filelist_path, fits, joint_fit);
+        if(!job_filelist_path.empty())
+        {
+            std::remove(job_filelist_path.c_str());
+        }
+    }
+    else
     {
-        fit.FillHists();
+        std::cout << "Merging partial histograms..." << std::endl;
+        for(auto& partial_path: partial_paths)
+        {
+            TFile* partial_file = TFile::Open(partial_path.c_str(), "read");
+            if(!partial_file || partial_file->IsZombie())
+            {
+                cerr << "Could not open partial file " << partial_path << endl;
+                return 1;
+            }
+            for(auto& fit: fits)
+            {
+                if(!fit.MergeHists(partial_file))
+                {
+                    cerr << "Partial file " << partial_path << " is missing histograms for --nbins "
+                         << nbins << "; it is not a gauss_fit output or was made with other binning" << endl;
+                    return 1;
+                }
+            }
+            if(joint_fit && !joint_fit->MergeHists(partial_file))
+            {
+                cerr << "Partial file " << partial_path
+                     << " has no inclusive histograms for the joint fit" << endl;
+                return 1;
+            }
+            partial_file->Close();
+        }
     }
 
-    std::cout << "Fitting histograms..." << std::endl;
-    for(auto& fit: fits)
+    if(fit_hists)
     {
-        fit.FitHists();
-        fit.ConcatenateFits();
+        std::cout << "Fitting histograms..." << std::endl;
+        for(auto& fit: fits)
+        {
+            fit.FitHists();
+            fit.ConcatenateFits();
+        }
+        if(joint_fit)
+        {
+            std::cout << "Fitting species and background jointly..." << std::endl;
+            joint_fit->FitHists(fits);
+            joint_fit->ConcatenateFits();
+        }
     }
 
-    TFile* out_file = TFile::Open(out_path.c_str(), "recreate");
+    auto write_start = std::chrono::steady_clock::now();
+    TFile* out_file = GAUSPID::OpenOutputFile(out_path, output_config);
+    if(!out_file)
+    {
+        return 1;
+    }
 
     std::cout << "Writing to file..." << std::endl;
     for(auto& fit: fits)
     {
-        fit.WriteHists();
+        if(fit_hists)
+        {
+            fit.WriteHists();
+        }
+        else
+        {
+            fit.WritePartialHists();
+        }
+    }
+    if(joint_fit)
+    {
+        if(fit_hists)
+        {
+            joint_fit->WriteHists();
+        }
+        else
+        {
+            joint_fit->WritePartialHists();
+        }
     }
 
-    std::cout << "Done." << std::endl;
     out_file->Close();
+    std::chrono::duration<double> write_time = std::chrono::steady_clock::now() - write_start;
+    GAUSPID::PrintOutputReport(out_path, write_time.count());
+    std::cout << "Done." << std::endl;
     return 0;
 }
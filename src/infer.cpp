@@ -1,14 +1,18 @@
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <numeric>
 #include <string>
+#include <thread>
 #include <utility>
 #include <AnalysisTree/Chain.hpp>
 #include <AnalysisTree/Matching.hpp>
 #include <TF2.h>
 #include <TFile.h>
 #include <TH2F.h>
+#include <TROOT.h>
+#include "src/GAUSPIDOutput.hpp"
 #include "src/name_helpers.hpp"
 
 namespace GAUSPID
@@ -16,10 +20,17 @@ namespace GAUSPID
     class ParticleFit
     {
     public:
-        ParticleFit(TFile* hist_file, std::vector<int> pdg) : _pdg{pdg}
+        ParticleFit(TFile* hist_file, std::vector<int> pdg, bool joint = false) : _pdg{pdg}
         {
-            std::string hist_name = name_helpers::create_2d_fit_name(pdg);
+            std::string hist_name = joint ? name_helpers::create_2d_joint_fit_name(pdg)
+                                          : name_helpers::create_2d_fit_name(pdg);
             _fit = LoadFit(hist_file, hist_name);
+            if(!_fit)
+            {
+                std::cerr << "Fit " << hist_name << " not found in " << hist_file->GetName()
+                          << (joint ? ", was it made with gauss_fit --joint?" : "") << std::endl;
+                exit(1);
+            }
             std::cout << _fit->GetTitle() << std::endl;
             auto inferred_hist_name = name_helpers::create_2d_inferred_name(pdg);
             auto inferred_hist_title = name_helpers::create_2d_inferred_title(pdg);
@@ -64,12 +75,12 @@ namespace GAUSPID
             }
         }
 
-        void Write()
+        void Write(TFile* out_file, const OutputConfig& config)
         {
-            _hist->Write();
-            _hist_match->Write();
-            _hist_mismatch->Write();
-            _hist_mc_true->Write();
+            WriteHist(out_file, _hist, config);
+            WriteHist(out_file, _hist_match, config);
+            WriteHist(out_file, _hist_mismatch, config);
+            WriteHist(out_file, _hist_mc_true, config);
         }
 
         void PrintStats()
@@ -102,7 +113,7 @@ namespace GAUSPID
     private:
         TF2* LoadFit(TFile* hist_file, std::string hist_name)
         {
-            TF2* fit;
+            TF2* fit = nullptr;
             hist_file->GetObject(hist_name.c_str(), fit);
             return fit;
         }
@@ -118,13 +129,39 @@ namespace GAUSPID
     class Inferrer
     {
     public:
-        Inferrer(std::string hist_file_path, std::vector<std::vector<int>> pdgs, const float purity_cut = 0.9) :
+        // DeduceType returns {0} for tracks no class claims with enough
+        // purity, and {kBackgroundLabel} for tracks the fitted background claims
+        static constexpr int kBackgroundLabel = -1;
+
+        Inferrer(std::string hist_file_path, std::vector<std::vector<int>> pdgs, const float purity_cut = 0.9, const bool joint = false) :
             _purity_cut{purity_cut}
         {
             auto hist_file = new TFile(hist_file_path.c_str(), "READ");
             for(auto& pdg: pdgs)
             {
-                _classes.push_back(ParticleFit(hist_file, pdg));
+                _classes.push_back(ParticleFit(hist_file, pdg, joint));
+            }
+
+            // the joint fit models the background explicitly, so it competes
+            // with the particle classes instead of being only the leftover
+            _bg_fit = nullptr;
+            _bg_fit_hist = nullptr;
+            if(joint)
+            {
+                auto bg_fit_name = name_helpers::create_2d_joint_fit_name("background");
+                hist_file->GetObject(bg_fit_name.c_str(), _bg_fit);
+                if(!_bg_fit)
+                {
+                    std::cerr << "Background fit " << bg_fit_name << " not found in "
+                              << hist_file_path << ", was it made with gauss_fit --joint?" << std::endl;
+                    exit(1);
+                }
+                auto bg_fit_hist_name =
+                    name_helpers::create_2d_inferred_name("fitted-background");
+                auto bg_fit_hist_title =
+                    name_helpers::create_2d_inferred_title("fitted background");
+                _bg_fit_hist = new TH2F(
+                    bg_fit_hist_name.c_str(), bg_fit_hist_title.c_str(), 200, 0, 6, 200, -1, 2);
             }
 
             auto bg_hist_name =
@@ -148,12 +185,23 @@ namespace GAUSPID
                 std::end(prob_map),
                 [](std::pair<ParticleFit*, float> a, std::pair<ParticleFit*, float> b)
                 { return a.second < b.second; });
-            const float all_particle_counts = std::accumulate(
+            // accumulate in float: an int seed would truncate every partial sum
+            float all_particle_counts = std::accumulate(
                 std::begin(prob_map),
                 std::end(prob_map),
-                0,
+                0.f,
                 [](const float previous, const std::pair<ParticleFit*, float> p)
                 { return previous + p.second; });
+            if(_bg_fit)
+            {
+                const float bg_counts = _bg_fit->Eval(p, m2);
+                all_particle_counts += bg_counts;
+                if(bg_counts > most_likely_particle.second && bg_counts / all_particle_counts > _purity_cut)
+                {
+                    _bg_fit_hist->Fill(p, m2);
+                    return {kBackgroundLabel};
+                }
+            }
             if(most_likely_particle.second / all_particle_counts > _purity_cut)
             {
                 most_likely_particle.first->Fill(p, m2, mc_pdg);
@@ -163,13 +211,17 @@ namespace GAUSPID
             return {0};
         }
 
-        void WriteHistograms()
+        void WriteHistograms(TFile* out_file, const OutputConfig& config)
         {
             for(auto c: _classes)
             {
-                c.Write();
+                c.Write(out_file, config);
+            }
+            WriteHist(out_file, _bg_hist, config);
+            if(_bg_fit_hist)
+            {
+                WriteHist(out_file, _bg_fit_hist, config);
             }
-            _bg_hist->Write();
         }
 
         void PrintStats()
@@ -178,12 +230,19 @@ namespace GAUSPID
             {
                 c.PrintStats();
             }
+            if(_bg_fit_hist)
+            {
+                std::cout << std::endl << "# fitted background = " << _bg_fit_hist->GetEntries() << std::endl;
+            }
+            std::cout << "# unidentified = " << _bg_hist->GetEntries() << std::endl;
         }
 
     private:
         std::vector<ParticleFit> _classes;
         std::vector<TH2F*> _histograms;
         TH2F* _bg_hist;
+        TF2* _bg_fit;
+        TH2F* _bg_fit_hist;
         const float _purity_cut;
     };
 
@@ -201,6 +260,8 @@ int main(int argc, char** argv)
     std::string filelist_path = "filelist_validate.txt";
     std::string out_path = "gauss_inferred.root";
     std::string hist_path = "gauss_out.root ";
+    bool joint = false;
+    GAUSPID::OutputConfig output_config;
 
     using std::cout;
     using std::endl;
@@ -221,6 +282,34 @@ int main(int argc, char** argv)
             hist_path = std::string(argv[++i]);
             cout << "Path to hitogram ROOT file: " << hist_path << endl;
         }
+        if(check_argparse(argv[i], "--joint", "-jf"))
+        {
+            joint = true;
+            cout << "Using joint species + background fits" << endl;
+        }
+        if(check_argparse(argv[i], "--compression", "-c"))
+        {
+            if(!GAUSPID::ParseCompressionAlgorithm(argv[++i], output_config))
+            {
+                std::cerr << "Unknown compression algorithm: " << argv[i] << endl;
+                return 1;
+            }
+            cout << "Compression algorithm: " << argv[i] << endl;
+        }
+        if(check_argparse(argv[i], "--compression-level", "-cl"))
+        {
+            if(!GAUSPID::ParseCompressionLevel(argv[++i], output_config))
+            {
+                std::cerr << "Invalid compression level: " << argv[i] << " (expected 0-9)" << endl;
+                return 1;
+            }
+            cout << "Compression level: " << output_config.level << endl;
+        }
+        if(check_argparse(argv[i], "--sparse", "-s"))
+        {
+            output_config.sparse = true;
+            cout << "Writing sparse histograms" << endl;
+        }
     }
 
     const std::vector<int> proton_pdg = {2212};
@@ -228,7 +317,7 @@ int main(int argc, char** argv)
     const std::vector<int> pion_pdg = {-13, 211, -11};
     const std::vector<std::vector<int>> pdgs = {proton_pdg, kaon_pdg, pion_pdg};
 
-    auto inferrer = new GAUSPID::Inferrer(hist_path, pdgs);
+    auto inferrer = new GAUSPID::Inferrer(hist_path, pdgs, 0.9, joint);
 
     namespace at = AnalysisTree;
     auto chain = new at::Chain(
@@ -265,9 +354,26 @@ int main(int argc, char** argv)
             }
         }
     }
-    TFile* out_file = TFile::Open(out_path.c_str(), "recreate");
+
+    // serialize on a separate thread while the statistics are printed; the
+    // writer only streams the histograms and PrintStats only reads entry counts
+    ROOT::EnableThreadSafety();
+    TFile* out_file = GAUSPID::OpenOutputFile(out_path, output_config);
+    if(!out_file)
+    {
+        return 1;
+    }
+    std::chrono::duration<double> write_time;
+    std::thread writer(
+        [&]()
+        {
+            auto write_start = std::chrono::steady_clock::now();
+            inferrer->WriteHistograms(out_file, output_config);
+            out_file->Close();
+            write_time = std::chrono::steady_clock::now() - write_start;
+        });
     inferrer->PrintStats();
-    inferrer->WriteHistograms();
-    out_file->Close();
+    writer.join();
+    GAUSPID::PrintOutputReport(out_path, write_time.count());
     return 0;
 }
@@ -69,6 +69,32 @@ namespace name_helpers
             " , " + std::to_string(p_max) + ");m^{2}, (GeV^{2}/c^{4});counts";
     }
 
+    inline const std::string create_1d_joint_hist_name(float p_min, float p_max)
+    {
+        return "inclusive_hist_" + std::to_string(p_min) + "_" + std::to_string(p_max);
+    }
+
+    inline const std::string create_1d_joint_fit_name(std::vector<int> pdgs, float p_min, float p_max)
+    {
+        std::string pdg_str = "";
+        for(auto& pdg: pdgs)
+        {
+            pdg_str = pdg_str + std::to_string(pdg) + "_";
+        }
+        return pdg_str + "joint_fit_" + std::to_string(p_min) + "_" + std::to_string(p_max);
+    }
+
+    inline const std::string create_1d_joint_fit_name(std::string particle_name, float p_min, float p_max)
+    {
+        return particle_name + "_joint_fit_" + std::to_string(p_min) + "_" + std::to_string(p_max);
+    }
+
+    inline const std::string create_1d_joint_fit_title(float p_min, float p_max)
+    {
+        return "joint gaussian + background fit for p in (" + std::to_string(p_min) +
+            " , " + std::to_string(p_max) + ");m^{2}, (GeV^{2}/c^{4});counts";
+    }
+
     inline const std::string create_2d_fit_name(std::vector<int> pdgs)
     {
         std::string pdg_str = "";
@@ -85,6 +111,26 @@ namespace name_helpers
         return pdg_str + " gaussian fit;p, (GeV/c);m^{2} , (GeV^{2}/c^{4}) ;";
     }
 
+    inline const std::string create_2d_joint_fit_name(std::vector<int> pdgs)
+    {
+        std::string pdg_str = "";
+        for(auto& pdg: pdgs)
+        {
+            pdg_str = pdg_str + std::to_string(pdg) + "_";
+        }
+        return pdg_str + "joint_fit";
+    }
+
+    inline const std::string create_2d_joint_fit_name(std::string particle_name)
+    {
+        return particle_name + "_joint_fit";
+    }
+
+    inline const std::string create_2d_joint_fit_title(std::string particle_name)
+    {
+        return particle_name + " joint fit;p, (GeV/c);m^{2} , (GeV^{2}/c^{4}) ;";
+    }
+
     inline const std::string create_2d_inferred_name(std::vector<int> pdgs)
     {
         std::string pdg_str = "";
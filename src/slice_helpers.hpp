@@ -0,0 +1,78 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <TF1.h>
+#include <TF2.h>
+#include <TFile.h>
+#include <TH1.h>
+
+// Shared by the momentum slice classes (Fit1D, FitJoint1D) and their 2D
+// containers (Fit2D, FitJoint2D).
+namespace slice_helpers
+{
+
+    inline void write_hist(TH1* hist, TF1* fit)
+    {
+        fit->SetNpx(1000);
+        hist->Write();
+    }
+
+    inline void write_fit2d(TF2* fit2d)
+    {
+        fit2d->SetNpx(200);
+        fit2d->SetNpy(200);
+        fit2d->Write();
+    }
+
+    // Adds the histogram of the same name from file to hist.
+    inline bool merge_hist(TH1* hist, TFile* file)
+    {
+        TH1* partial = nullptr;
+        file->GetObject(hist->GetName(), partial);
+        if(!partial)
+        {
+            std::cerr << "Histogram " << hist->GetName() << " not found in "
+                      << file->GetName() << std::endl;
+            return false;
+        }
+        hist->Add(partial);
+        delete partial;
+        return true;
+    }
+
+    template <typename Slice>
+    const Slice* find_slice(const std::vector<Slice>& slices, const double p)
+    {
+        for(auto& slice: slices)
+        {
+            if(p > slice.GetPMin() && p <= slice.GetPMax())
+            {
+                return &slice;
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename Slice>
+    void write_hists(std::vector<Slice>& slices)
+    {
+        for(auto& slice: slices)
+        {
+            slice.WriteHist();
+        }
+    }
+
+    template <typename Slice>
+    bool merge_hists(std::vector<Slice>& slices, TFile* file)
+    {
+        for(auto& slice: slices)
+        {
+            if(!slice.MergeHist(file))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace slice_helpers